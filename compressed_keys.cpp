@@ -0,0 +1,169 @@
+#include "compressed_keys.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <limits>
+
+namespace lower_bound {
+
+namespace {
+
+// Delta returns "key - base" without overflow.  Requires base <= key.
+std::uint32_t Delta(int key, int base) {
+  return static_cast<std::uint32_t>(key) - static_cast<std::uint32_t>(base);
+}
+
+// AppendBlock stores the deltas of "keys" from "base" in "deltas", padded
+// to kBlockSize.
+template <typename T>
+void AppendBlock(std::span<const int> keys, int base, std::vector<T>& deltas) {
+  const std::size_t offset = deltas.size();
+  for (int key : keys) {
+    deltas.push_back(static_cast<T>(Delta(key, base)));
+  }
+  deltas.resize(offset + CompressedKeys::kBlockSize,
+                std::numeric_limits<T>::max());
+}
+
+// CountLess returns how many of the block's deltas are less than "target".
+// A fixed trip count and no early exit let the compiler vectorize the
+// loop into packed compares.  The count fits in T, so keeping it at the
+// deltas' width avoids widening every compare result.
+template <typename T>
+std::size_t CountLess(const T* deltas, std::uint32_t target) {
+  if (target > std::numeric_limits<T>::max()) {
+    return CompressedKeys::kBlockSize;
+  }
+  static_assert(CompressedKeys::kBlockSize <= std::numeric_limits<T>::max());
+  const T narrow = static_cast<T>(target);
+  T count = 0;
+  for (std::size_t i = 0; i < CompressedKeys::kBlockSize; ++i) {
+    count += deltas[i] < narrow;
+  }
+  return count;
+}
+
+}  // namespace
+
+CompressedKeys::CompressedKeys(std::span<const int> keys)
+    : size_(keys.size()) {
+  assert(std::is_sorted(keys.begin(), keys.end()));
+  Group group = {0, 0};
+  std::uint8_t ranks[3] = {0, 0, 0};
+  for (std::size_t begin = 0; begin < keys.size(); begin += kBlockSize) {
+    std::span<const int> block =
+        keys.subspan(begin, std::min(kBlockSize, keys.size() - begin));
+    const int base = block.front();
+    const std::uint32_t max_delta = Delta(block.back(), base);
+    if (bases_.size() % kGroupSize == 0) {
+      fences_.push_back(base);
+      groups_.push_back(group);
+      std::fill(std::begin(ranks), std::end(ranks), 0);
+    }
+    bases_.push_back(base);
+    Width width;
+    if (max_delta <= std::numeric_limits<std::uint8_t>::max()) {
+      AppendBlock(block, base, deltas8_);
+      width = kWidth8;
+      ++group.blocks8;
+    } else if (max_delta <= std::numeric_limits<std::uint16_t>::max()) {
+      AppendBlock(block, base, deltas16_);
+      width = kWidth16;
+      ++group.blocks16;
+    } else {
+      AppendBlock(block, base, deltas32_);
+      width = kWidth32;
+    }
+    codes_.push_back(width << kRankBits | ranks[width]++);
+  }
+  bases_.resize(groups_.size() * kGroupSize, INT_MAX);
+}
+
+std::size_t CompressedKeys::DeltaOffset(std::size_t block) const {
+  const std::size_t group = block / kGroupSize;
+  const Group& counts = groups_[group];
+  const std::size_t rank = codes_[block] & ((1 << kRankBits) - 1);
+  switch (codes_[block] >> kRankBits) {
+    case kWidth8:
+      return (counts.blocks8 + rank) * kBlockSize;
+    case kWidth16:
+      return (counts.blocks16 + rank) * kBlockSize;
+    default:
+      return (group * kGroupSize - counts.blocks8 - counts.blocks16 + rank) *
+             kBlockSize;
+  }
+}
+
+ATTRIBUTE_NOIPA std::size_t CompressedKeys::LowerBound(int key) const {
+  // Find the last block whose base is less than "key".  Every key before
+  // the following block's base is less than "key", so the answer is in
+  // that block or is the following base itself.
+  if (fences_.empty()) {
+    return 0;
+  }
+  const int* first = fences_.data();
+  std::size_t n = fences_.size();
+  while (n > 1) {
+    std::size_t half = n / 2;
+    first = first[half] < key ? first + half : first;
+    n -= half;
+  }
+  if (!(*first < key)) {
+    return 0;
+  }
+  const std::size_t group = first - fences_.data();
+  const int* bases = &bases_[group * kGroupSize];
+  std::uint32_t less = 0;
+  for (std::size_t i = 0; i < kGroupSize; ++i) {
+    less += bases[i] < key;
+  }
+  const std::size_t block = group * kGroupSize + less - 1;
+
+  const std::size_t offset = DeltaOffset(block);
+  const std::uint32_t target = Delta(key, bases_[block]);
+  std::size_t count;
+  switch (codes_[block] >> kRankBits) {
+    case kWidth8:
+      count = CountLess(&deltas8_[offset], target);
+      break;
+    case kWidth16:
+      count = CountLess(&deltas16_[offset], target);
+      break;
+    default:
+      count = CountLess(&deltas32_[offset], target);
+      break;
+  }
+  return std::min(block * kBlockSize + count, size_);
+}
+
+int CompressedKeys::Key(std::size_t index) const {
+  assert(index < size_);
+  const std::size_t block = index / kBlockSize;
+  const std::size_t offset = DeltaOffset(block) + index % kBlockSize;
+  std::uint32_t delta;
+  switch (codes_[block] >> kRankBits) {
+    case kWidth8:
+      delta = deltas8_[offset];
+      break;
+    case kWidth16:
+      delta = deltas16_[offset];
+      break;
+    default:
+      delta = deltas32_[offset];
+      break;
+  }
+  return static_cast<int>(static_cast<std::uint32_t>(bases_[block]) + delta);
+}
+
+std::size_t CompressedKeys::MemoryBytes() const {
+  return fences_.size() * sizeof(fences_[0]) +
+         bases_.size() * sizeof(bases_[0]) +
+         codes_.size() * sizeof(codes_[0]) +
+         groups_.size() * sizeof(groups_[0]) +
+         deltas8_.size() * sizeof(deltas8_[0]) +
+         deltas16_.size() * sizeof(deltas16_[0]) +
+         deltas32_.size() * sizeof(deltas32_[0]);
+}
+
+}  // namespace lower_bound
@@ -0,0 +1,83 @@
+#ifndef COMPRESSED_KEYS_H
+#define COMPRESSED_KEYS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "lower_bound.h"
+
+namespace lower_bound {
+
+// CompressedKeys is a read-only sorted key set stored in frame-of-reference
+// blocks.
+//
+// Keys are split into blocks of kBlockSize.  Each block keeps its first
+// key as a base and the rest as unsigned deltas from that base, packed at
+// the narrowest of 8, 16 or 32 bits that fits the block.  Dense key sets,
+// such as the 1..N keys the layouts use, take one byte per key.
+//
+// Blocks are gathered into groups of kGroupSize.  The top separator level
+// holds one base per group: 8 KB for 2^24 keys and 32 KB for 2^26, small
+// enough for L1.  A lookup binary searches it, scans one group's bases,
+// then scans one block.
+class CompressedKeys {
+ public:
+  static constexpr std::size_t kBlockSize = 128;
+  static constexpr std::size_t kGroupSize = 64;
+
+  // Build from "keys", which must be sorted.
+  explicit CompressedKeys(std::span<const int> keys);
+
+  // LowerBound returns the index of the first key not less than "key", or
+  // size() if there is no such key.  When the keys are those of a tree,
+  // this is the in-order position of lower_bound::LowerBound's result.
+  ATTRIBUTE_NOIPA std::size_t LowerBound(int key) const;
+
+  // Key returns the key at "index", which must be less than size().
+  int Key(std::size_t index) const;
+
+  std::size_t size() const { return size_; }
+
+  // MemoryBytes returns the footprint of the compressed representation,
+  // including both separator levels and the per-block codes.
+  std::size_t MemoryBytes() const;
+
+ private:
+  // Group counts the blocks of each narrow width in the groups before it.
+  struct Group {
+    std::uint32_t blocks8;
+    std::uint32_t blocks16;
+  };
+
+  // A block's code packs the width of its deltas in the top two bits and
+  // its rank among blocks of that width within its group in the low six.
+  // Together with its Group, that locates the block's deltas.
+  static constexpr int kRankBits = 6;
+  static_assert(kGroupSize <= 1 << kRankBits);
+  enum Width : std::uint8_t { kWidth8, kWidth16, kWidth32 };
+
+  // DeltaOffset returns where "block"'s deltas start in the array for its
+  // width.
+  std::size_t DeltaOffset(std::size_t block) const;
+
+  std::size_t size_ = 0;
+
+  // fences_ holds the first base of each group.  bases_ holds one base
+  // per block, padded to whole groups with INT_MAX.
+  std::vector<int> fences_;
+  std::vector<int> bases_;
+  std::vector<std::uint8_t> codes_;
+  std::vector<Group> groups_;
+
+  // Every block holds exactly kBlockSize deltas.  The last block is padded
+  // with the largest value of its width, which no search ever counts.
+  std::vector<std::uint8_t> deltas8_;
+  std::vector<std::uint16_t> deltas16_;
+  std::vector<std::uint32_t> deltas32_;
+};
+
+}  // namespace lower_bound
+
+#endif
@@ -0,0 +1,144 @@
+#include "compressed_keys.h"
+
+#include <climits>
+
+#include "absl/random/random.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lower_bound_test.h"
+
+namespace {
+
+// ExpectMatchesLowerBound checks CompressedKeys::LowerBound against
+// std::lower_bound for every key in "keys" and its neighbours.
+void ExpectMatchesLowerBound(const std::vector<int>& keys) {
+  lower_bound::CompressedKeys compressed(keys);
+  ASSERT_EQ(compressed.size(), keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(compressed.Key(i), keys[i]) << "index " << i;
+  }
+  std::vector<int> probes = {INT_MIN, INT_MAX};
+  for (int key : keys) {
+    probes.push_back(key);
+    if (key > INT_MIN) {
+      probes.push_back(key - 1);
+    }
+    if (key < INT_MAX) {
+      probes.push_back(key + 1);
+    }
+  }
+  for (int probe : probes) {
+    std::size_t expected =
+        std::lower_bound(keys.begin(), keys.end(), probe) - keys.begin();
+    ASSERT_EQ(compressed.LowerBound(probe), expected) << "probe " << probe;
+  }
+}
+
+TEST(CompressedKeys, Empty) {
+  lower_bound::CompressedKeys compressed({});
+  EXPECT_EQ(compressed.size(), 0);
+  EXPECT_EQ(compressed.LowerBound(0), 0);
+  EXPECT_EQ(compressed.MemoryBytes(), 0);
+}
+
+TEST(CompressedKeys, MatchesTreeLowerBound) {
+  using lower_bound::CompressedKeys;
+  using lower_bound::LowerBound;
+  using lower_bound::Node;
+
+  // For the keys of a tree, the index returned is the in-order position of
+  // the node LowerBound returns.
+  absl::BitGen bitgen;
+  for (int size : {1, 3, 7, 127, 1023}) {
+    std::vector<Node> nodes(size);
+    Node* root = LayoutAtRandom(nodes, bitgen);
+    std::vector<const Node*> in_order;
+    lower_bound::VisitInOrder(
+        root, [&](const Node* node) { in_order.push_back(node); });
+    CompressedKeys compressed(lower_bound::KeysInOrder(root));
+    for (int key = 0; key <= size + 1; ++key) {
+      std::size_t index = compressed.LowerBound(key);
+      Node* node = LowerBound(root, key);
+      if (node == nullptr) {
+        EXPECT_EQ(index, size);
+      } else {
+        ASSERT_LT(index, size);
+        EXPECT_EQ(in_order[index], node);
+      }
+    }
+  }
+}
+
+TEST(CompressedKeys, BlockWidths) {
+  // Dense keys need 8-bit deltas, and the partial last block is padded.
+  std::vector<int> dense;
+  for (int key = 1; key <= 1000; ++key) {
+    dense.push_back(key);
+  }
+  ExpectMatchesLowerBound(dense);
+
+  // Gaps that force 16-bit and 32-bit blocks, mixed with narrow ones.
+  std::vector<int> mixed;
+  for (int key = -100000; key < 100000; key += 500) {
+    mixed.push_back(key);
+  }
+  for (int key = 200000; key < 200300; ++key) {
+    mixed.push_back(key);
+  }
+  mixed.push_back(INT_MAX);
+  ExpectMatchesLowerBound(mixed);
+
+  // The full range of int in a single block.
+  ExpectMatchesLowerBound({INT_MIN, -1, 0, 1, INT_MAX});
+}
+
+TEST(CompressedKeys, ManyGroups) {
+  // Enough blocks for several groups, with widths changing from block to
+  // block so each width's deltas are located across group boundaries.
+  using lower_bound::CompressedKeys;
+  std::vector<int> keys;
+  int key = -1000000;
+  const int kGaps[] = {1, 300, 100000, 2, 1000};
+  for (std::size_t block = 0; block < 5 * CompressedKeys::kGroupSize + 3;
+       ++block) {
+    for (std::size_t i = 0; i < CompressedKeys::kBlockSize; ++i) {
+      keys.push_back(key);
+      key += kGaps[block % 5] / 2 + 1;
+    }
+  }
+  ExpectMatchesLowerBound(keys);
+}
+
+TEST(CompressedKeys, DuplicateKeys) {
+  // Runs of duplicates, including runs that span block boundaries.
+  std::vector<int> keys;
+  for (int key = 0; key < 20; ++key) {
+    keys.insert(keys.end(), 37, key * 3);
+  }
+  ExpectMatchesLowerBound(keys);
+  ExpectMatchesLowerBound(std::vector<int>(300, 5));
+}
+
+TEST(CompressedKeys, RandomKeys) {
+  absl::BitGen bitgen;
+  for (int max : {100, 100000, INT_MAX}) {
+    std::vector<int> keys;
+    for (int i = 0; i < 2000; ++i) {
+      keys.push_back(absl::Uniform(absl::IntervalClosed, bitgen, -max, max));
+    }
+    std::sort(keys.begin(), keys.end());
+    ExpectMatchesLowerBound(keys);
+  }
+}
+
+TEST(CompressedKeys, MemoryBytes) {
+  // 1..N keys take about one byte each, a quarter of a plain int array.
+  std::vector<int> keys;
+  for (int key = 1; key <= (1 << 16); ++key) {
+    keys.push_back(key);
+  }
+  lower_bound::CompressedKeys compressed(keys);
+  EXPECT_LT(compressed.MemoryBytes(), keys.size() * sizeof(int) / 3);
+}
+
+}  // namespace
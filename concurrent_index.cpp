@@ -0,0 +1,155 @@
+#include "concurrent_index.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+namespace lower_bound {
+
+namespace {
+
+// BuildRecur links nodes[begin, end) into a balanced subtree and returns
+// its root.  Nodes keep their array positions, so the array stays in
+// ascending key order.
+Node* BuildRecur(std::span<Node> nodes, std::size_t begin, std::size_t end) {
+  if (begin == end) {
+    return nullptr;
+  }
+  std::size_t middle = begin + (end - begin) / 2;
+  Node& node = nodes[middle];
+  node.left() = BuildRecur(nodes, begin, middle);
+  node.right() = BuildRecur(nodes, middle + 1, end);
+  return &node;
+}
+
+// ApplyUpdates returns "keys" with one occurrence of each of "erases"
+// removed and all of "inserts" added.  All three must be sorted.
+std::vector<int> ApplyUpdates(const std::vector<int>& keys,
+                              const std::vector<int>& inserts,
+                              const std::vector<int>& erases) {
+  std::vector<int> kept;
+  kept.reserve(keys.size());
+  auto erase = erases.begin();
+  for (int key : keys) {
+    while (erase != erases.end() && *erase < key) {
+      ++erase;
+    }
+    if (erase != erases.end() && *erase == key) {
+      ++erase;
+    } else {
+      kept.push_back(key);
+    }
+  }
+
+  std::vector<int> merged;
+  merged.reserve(kept.size() + inserts.size());
+  std::merge(kept.begin(), kept.end(), inserts.begin(), inserts.end(),
+             std::back_inserter(merged));
+  return merged;
+}
+
+}  // namespace
+
+std::unique_ptr<Snapshot> BuildSnapshot(std::span<const int> keys) {
+  assert(std::is_sorted(keys.begin(), keys.end()));
+  auto snapshot = std::make_unique<Snapshot>();
+  snapshot->nodes.resize(keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    snapshot->nodes[i].key = keys[i];
+  }
+  snapshot->root = BuildRecur(snapshot->nodes, 0, keys.size());
+  return snapshot;
+}
+
+ConcurrentIndex::ConcurrentIndex(std::vector<int> keys, int max_readers)
+    : slots_(std::make_unique<ReaderSlot[]>(max_readers)),
+      max_readers_(max_readers),
+      keys_(std::move(keys)) {
+  std::sort(keys_.begin(), keys_.end());
+  std::unique_ptr<Snapshot> snapshot = BuildSnapshot(keys_);
+  snapshot->as_of = std::chrono::steady_clock::now();
+  current_.store(snapshot.release());
+}
+
+ConcurrentIndex::~ConcurrentIndex() { delete current_.load(); }
+
+std::atomic<std::uint64_t>& ConcurrentIndex::ReaderEpoch(int reader) const {
+  assert(reader >= 0 && reader < max_readers_);
+  return slots_[reader].epoch;
+}
+
+// A reader publishes the epoch it read before loading current_, and the
+// writer advances the epoch after swapping current_.  These accesses, and
+// the writer's scan of the slots, are sequentially consistent, so a
+// reader that loaded a snapshot retired at epoch E has published an epoch
+// no greater than E, and a reader whose slot the writer saw as idle or
+// newer than E can only load a snapshot published after the swap.
+//
+// Leaving only needs a release store: the writer's sequentially
+// consistent load of the slot acquires it, so the reader's last use of
+// the snapshot happens before the writer frees it.
+ConcurrentIndex::ReadGuard::ReadGuard(const ConcurrentIndex& index,
+                                      int reader)
+    : slot_(index.ReaderEpoch(reader)) {
+  assert(slot_.load(std::memory_order_relaxed) == kIdle);
+  slot_.store(index.epoch_.load());
+  snapshot_ = index.current_.load();
+}
+
+ConcurrentIndex::ReadGuard::~ReadGuard() {
+  slot_.store(kIdle, std::memory_order_release);
+}
+
+void ConcurrentIndex::Insert(int key) {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  inserts_.push_back(key);
+}
+
+void ConcurrentIndex::Erase(int key) {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  erases_.push_back(key);
+}
+
+std::uint64_t ConcurrentIndex::Publish() {
+  std::lock_guard<std::mutex> publish_lock(publish_mutex_);
+
+  std::vector<int> inserts;
+  std::vector<int> erases;
+  std::chrono::steady_clock::time_point as_of;
+  {
+    std::lock_guard<std::mutex> pending_lock(pending_mutex_);
+    inserts.swap(inserts_);
+    erases.swap(erases_);
+    as_of = std::chrono::steady_clock::now();
+  }
+  std::sort(inserts.begin(), inserts.end());
+  std::sort(erases.begin(), erases.end());
+  keys_ = ApplyUpdates(keys_, inserts, erases);
+
+  std::unique_ptr<Snapshot> snapshot = BuildSnapshot(keys_);
+  snapshot->as_of = as_of;
+  snapshot->version = current_.load(std::memory_order_relaxed)->version + 1;
+  const std::uint64_t version = snapshot->version;
+
+  const Snapshot* old = current_.exchange(snapshot.release());
+  retired_.emplace_back(epoch_.fetch_add(1), old);
+  Reclaim();
+  return version;
+}
+
+void ConcurrentIndex::Reclaim() {
+  std::uint64_t oldest = kIdle;
+  for (int i = 0; i < max_readers_; ++i) {
+    oldest = std::min(oldest, slots_[i].epoch.load());
+  }
+  std::erase_if(retired_, [oldest](const auto& retired) {
+    return retired.first < oldest;
+  });
+}
+
+std::size_t ConcurrentIndex::RetiredCount() const {
+  std::lock_guard<std::mutex> lock(publish_mutex_);
+  return retired_.size();
+}
+
+}  // namespace lower_bound
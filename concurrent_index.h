@@ -0,0 +1,129 @@
+#ifndef CONCURRENT_INDEX_H
+#define CONCURRENT_INDEX_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "lower_bound.h"
+
+namespace lower_bound {
+
+// Snapshot is an immutable binary search tree built from a sorted key set.
+// Nodes are allocated in an array in ascending key order, the same
+// arrangement as MemoryLayout::kAscending in the benchmark.
+struct Snapshot {
+  std::vector<Node> nodes;
+  Node* root = nullptr;
+
+  // version counts publications; the initial snapshot is version zero.
+  std::uint64_t version = 0;
+
+  // as_of is when the writer stopped taking updates for this snapshot.
+  // Every update submitted before as_of is reflected in it.
+  std::chrono::steady_clock::time_point as_of;
+};
+
+// ConcurrentIndex serves LowerBound lookups from any number of threads
+// while a writer changes the key set.
+//
+// Readers never take a lock.  They search an immutable Snapshot, found
+// through a single atomic pointer.  Writers queue Insert and Erase calls,
+// and Publish rebuilds a fresh Snapshot and swaps it in.  The rebuild runs
+// synchronously on the thread that calls Publish, so callers should
+// publish from a dedicated writer thread, off their own hot path; readers
+// keep using the previous Snapshot until the swap.  Replaced snapshots
+// are freed by epoch-based reclamation once no reader can still be
+// looking at them.
+//
+// Each reading thread is identified by a "reader" index in [0,
+// max_readers).  Two threads must not use the same index at once.
+class ConcurrentIndex {
+ public:
+  ConcurrentIndex(std::vector<int> keys, int max_readers);
+  ~ConcurrentIndex();
+
+  ConcurrentIndex(const ConcurrentIndex&) = delete;
+  ConcurrentIndex& operator=(const ConcurrentIndex&) = delete;
+
+  // ReadGuard pins the current Snapshot for the guard's lifetime.  Nodes
+  // returned by searching snapshot() stay valid until the guard is
+  // destroyed.  Guards for the same reader must not nest.
+  class ReadGuard {
+   public:
+    ReadGuard(const ConcurrentIndex& index, int reader);
+    ~ReadGuard();
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+    const Snapshot& snapshot() const { return *snapshot_; }
+    Node* LowerBound(int key) const {
+      return lower_bound::LowerBound(snapshot_->root, key);
+    }
+
+   private:
+    std::atomic<std::uint64_t>& slot_;
+    const Snapshot* snapshot_;
+  };
+
+  // Insert and Erase queue an update for the next Publish.  Erase removes
+  // one occurrence of "key" and is ignored if there is none; within one
+  // Publish, erases apply before inserts.  Both may be called from any
+  // thread, and neither waits for a Publish in progress.
+  void Insert(int key);
+  void Erase(int key);
+
+  // Publish applies the queued updates, builds a new Snapshot on the
+  // calling thread, makes it visible to readers and reclaims retired
+  // snapshots no reader can still see.  It takes O(size) time and blocks
+  // other Publish calls, but never readers.  Returns the new Snapshot's
+  // version.
+  std::uint64_t Publish();
+
+  // RetiredCount returns the number of replaced snapshots not yet freed.
+  std::size_t RetiredCount() const;
+
+ private:
+  // kIdle marks a reader slot with no pinned epoch.  It compares greater
+  // than every real epoch, so idle slots never hold back reclamation.
+  static constexpr std::uint64_t kIdle = UINT64_MAX;
+
+  struct alignas(64) ReaderSlot {
+    std::atomic<std::uint64_t> epoch{kIdle};
+  };
+
+  // ReaderEpoch returns the epoch slot of "reader", which must be in [0,
+  // max_readers).
+  std::atomic<std::uint64_t>& ReaderEpoch(int reader) const;
+
+  void Reclaim();
+
+  std::atomic<const Snapshot*> current_;
+  std::atomic<std::uint64_t> epoch_{1};
+  std::unique_ptr<ReaderSlot[]> slots_;
+  const int max_readers_;
+
+  // Writer state.  Readers take neither mutex.  pending_mutex_ guards the
+  // queued updates and publish_mutex_ serializes Publish calls.
+  std::mutex pending_mutex_;
+  std::vector<int> inserts_;
+  std::vector<int> erases_;
+
+  mutable std::mutex publish_mutex_;
+  std::vector<int> keys_;
+  std::vector<std::pair<std::uint64_t, std::unique_ptr<const Snapshot>>>
+      retired_;
+};
+
+// BuildSnapshot returns a Snapshot holding "keys", which must be sorted.
+std::unique_ptr<Snapshot> BuildSnapshot(std::span<const int> keys);
+
+}  // namespace lower_bound
+
+#endif
@@ -0,0 +1,140 @@
+#include "concurrent_index.h"
+
+#include <atomic>
+#include <thread>
+
+#include "absl/random/random.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lower_bound_test.h"
+
+namespace {
+
+TEST(ConcurrentIndex, BuildSnapshot) {
+  using lower_bound::BuildSnapshot;
+  using lower_bound::ComputeTreeProperties;
+  using lower_bound::KeysInOrder;
+  using lower_bound::Snapshot;
+  using lower_bound::TreeProperties;
+
+  std::unique_ptr<Snapshot> empty = BuildSnapshot({});
+  EXPECT_EQ(empty->root, nullptr);
+
+  // Any size gives a balanced tree, not only complete ones.
+  std::vector<int> keys = {1, 2, 2, 3, 5, 8, 13, 21, 34, 55};
+  std::unique_ptr<Snapshot> snapshot = BuildSnapshot(keys);
+  TreeProperties properties = ComputeTreeProperties(snapshot->root);
+  EXPECT_EQ(properties.size, 10);
+  EXPECT_EQ(properties.height, 4);
+  EXPECT_EQ(KeysInOrder(snapshot->root), keys);
+  EXPECT_EQ(snapshot->nodes.front().key, 1);
+  EXPECT_EQ(snapshot->nodes.back().key, 55);
+}
+
+TEST(ConcurrentIndex, PublishMakesUpdatesVisible) {
+  using lower_bound::ConcurrentIndex;
+  using lower_bound::KeysInOrder;
+  using testing::ElementsAre;
+
+  ConcurrentIndex index({30, 10, 20}, 1);
+  {
+    ConcurrentIndex::ReadGuard guard(index, 0);
+    EXPECT_EQ(guard.snapshot().version, 0);
+    EXPECT_THAT(KeysInOrder(guard.snapshot().root), ElementsAre(10, 20, 30));
+    EXPECT_EQ(guard.LowerBound(11)->key, 20);
+  }
+
+  index.Insert(15);
+  index.Erase(20);
+  index.Erase(99);
+  {
+    // Queued updates are invisible until published.
+    ConcurrentIndex::ReadGuard guard(index, 0);
+    EXPECT_EQ(guard.LowerBound(11)->key, 20);
+  }
+
+  EXPECT_EQ(index.Publish(), 1);
+  ConcurrentIndex::ReadGuard guard(index, 0);
+  EXPECT_EQ(guard.snapshot().version, 1);
+  EXPECT_THAT(KeysInOrder(guard.snapshot().root), ElementsAre(10, 15, 30));
+  EXPECT_EQ(guard.LowerBound(11)->key, 15);
+  EXPECT_EQ(guard.LowerBound(16)->key, 30);
+  EXPECT_EQ(guard.LowerBound(31), nullptr);
+}
+
+TEST(ConcurrentIndex, ReclaimWaitsForReaders) {
+  using lower_bound::ConcurrentIndex;
+  using lower_bound::Node;
+
+  ConcurrentIndex index({1, 2, 3}, 2);
+  index.Publish();
+  EXPECT_EQ(index.RetiredCount(), 0);
+
+  // A pinned snapshot survives any number of publications, and so does
+  // everything retired after it.
+  auto guard = std::make_unique<ConcurrentIndex::ReadGuard>(index, 1);
+  Node* node = guard->LowerBound(2);
+  index.Insert(4);
+  index.Publish();
+  index.Publish();
+  EXPECT_EQ(index.RetiredCount(), 2);
+  EXPECT_EQ(node->key, 2);
+  EXPECT_EQ(guard->LowerBound(4), nullptr);
+
+  guard.reset();
+  index.Publish();
+  EXPECT_EQ(index.RetiredCount(), 0);
+}
+
+TEST(ConcurrentIndex, ConcurrentReadersAndWriter) {
+  using lower_bound::ConcurrentIndex;
+  using lower_bound::Node;
+
+  // The writer slides a window of kSize consecutive keys upward.  Every
+  // snapshot holds such a window, so a reader can check any answer
+  // against the snapshot's own smallest key.
+  constexpr int kSize = 1000;
+  constexpr int kReaders = 4;
+  std::vector<int> keys;
+  for (int key = 0; key < kSize; ++key) {
+    keys.push_back(key);
+  }
+  ConcurrentIndex index(keys, kReaders);
+
+  std::atomic<bool> done = false;
+  std::vector<std::thread> readers;
+  for (int reader = 0; reader < kReaders; ++reader) {
+    readers.emplace_back([&index, &done, reader] {
+      absl::BitGen bitgen;
+      while (!done.load()) {
+        ConcurrentIndex::ReadGuard guard(index, reader);
+        const int first = guard.snapshot().nodes.front().key;
+        const int key = absl::Uniform(bitgen, 0, first + 2 * kSize);
+        Node* node = guard.LowerBound(key);
+        if (key < first) {
+          ASSERT_EQ(node->key, first);
+        } else if (key < first + kSize) {
+          ASSERT_EQ(node->key, key);
+        } else {
+          ASSERT_EQ(node, nullptr);
+        }
+      }
+    });
+  }
+
+  for (int low = 0; low < 200 * 10; low += 10) {
+    for (int key = low; key < low + 10; ++key) {
+      index.Erase(key);
+      index.Insert(key + kSize);
+    }
+    index.Publish();
+  }
+  done.store(true);
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+  index.Publish();
+  EXPECT_EQ(index.RetiredCount(), 0);
+}
+
+}  // namespace
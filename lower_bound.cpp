@@ -1,9 +1,12 @@
 #include "lower_bound.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iostream>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace lower_bound {
 
@@ -57,4 +60,95 @@ Node* LowerBound(Node* x, int key) {
 }
 #endif
 
+namespace {
+
+// Unsorted batches smaller than this are searched one key at a time by
+// LowerBoundBatch.  Below this size the sort costs more than the shared
+// path prefixes save.
+constexpr std::size_t kMinSortBatchSize = 64;
+
+// Finger answers an ascending sequence of LowerBound queries against
+// one tree, resuming each search from the path left by the previous one.
+class Finger {
+ public:
+  explicit Finger(Node* root) { path_.push_back({root, nullptr}); }
+
+  Node* LowerBound(int key) {
+    // Every node before the subtree rooted at a frame's node is less than
+    // the previous key, and so less than "key" too.  Every node after it
+    // is at least as large as the frame's "lower".  The answer therefore
+    // lies in that subtree, or is "lower" itself, exactly when "key" is
+    // not greater than "lower".  The root's "lower" is null, meaning
+    // positive infinity, so the climb always stops there.
+    while (path_.back().lower != nullptr && path_.back().lower->key < key) {
+      path_.pop_back();
+    }
+
+    Frame top = path_.back();
+    if (top.node == nullptr) {
+      return nullptr;
+    }
+    path_.pop_back();
+    Node* x = top.node;
+    Node* lower = top.lower;
+    while (x != nullptr) {
+      path_.push_back({x, lower});
+      bool less = !(x->key < key);
+      lower = less ? x : lower;
+      x = x->links[!less];
+    }
+    return lower;
+  }
+
+ private:
+  // Frame records that the previous search entered "node" while holding
+  // "lower" as its best answer so far.
+  struct Frame {
+    Node* node;
+    Node* lower;
+  };
+
+  std::vector<Frame> path_;
+};
+
+}  // namespace
+
+ATTRIBUTE_NOIPA void LowerBoundSorted(Node* root, std::span<const int> keys,
+                                      std::span<Node*> results) {
+  assert(std::is_sorted(keys.begin(), keys.end()));
+  assert(results.size() >= keys.size());
+  Finger finger(root);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    results[i] = finger.LowerBound(keys[i]);
+  }
+}
+
+ATTRIBUTE_NOIPA void LowerBoundBatch(Node* root, std::span<const int> keys,
+                                     std::span<Node*> results) {
+  assert(results.size() >= keys.size());
+  if (std::is_sorted(keys.begin(), keys.end())) {
+    LowerBoundSorted(root, keys, results);
+    return;
+  }
+  if (keys.size() < kMinSortBatchSize) {
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      results[i] = LowerBound(root, keys[i]);
+    }
+    return;
+  }
+
+  // Sort (key, index) pairs so the finger can walk the keys in order and
+  // scatter each answer back to the caller's position.
+  std::vector<std::pair<int, std::size_t>> order;
+  order.reserve(keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    order.emplace_back(keys[i], i);
+  }
+  std::sort(order.begin(), order.end());
+  Finger finger(root);
+  for (const auto& [key, index] : order) {
+    results[index] = finger.LowerBound(key);
+  }
+}
+
 }  // namespace lower_bound
@@ -14,6 +14,8 @@
 #define ATTRIBUTE_NOIPA __attribute__((noipa))
 #endif
 
+#include <span>
+
 namespace lower_bound {
 
 // Node is a binary tree node.  It has the usual left and right links and
@@ -41,6 +43,27 @@ struct Node {
 // tree.
 ATTRIBUTE_NOIPA Node* LowerBound(Node* x, int key);
 
+// LowerBoundSorted stores LowerBound(root, keys[i]) in results[i] for
+// every key.  The keys must be in ascending order and "results" must be at
+// least as large as "keys".
+//
+// This is a finger search.  It records the root-to-leaf path of the
+// previous lookup and starts each lookup from there, climbing only as far
+// as the nearest ancestor whose subtree must contain the answer.  Nearby
+// keys therefore cost O(log distance) rather than O(height), and the
+// nodes they touch tend to still be in cache.
+ATTRIBUTE_NOIPA void LowerBoundSorted(Node* root, std::span<const int> keys,
+                                      std::span<Node*> results);
+
+// LowerBoundBatch stores LowerBound(root, keys[i]) in results[i] for every
+// key, in any order.  "results" must be at least as large as "keys".
+//
+// Sorted batches go straight to LowerBoundSorted.  Unsorted batches large
+// enough to amortize the sort are sorted first and then searched with
+// LowerBoundSorted; small ones call LowerBound once per key.
+ATTRIBUTE_NOIPA void LowerBoundBatch(Node* root, std::span<const int> keys,
+                                     std::span<Node*> results);
+
 }  // namespace lower_bound
 
 #endif
@@ -1,13 +1,20 @@
 // Benchmark for a "lower bound" search on a binary tree.
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <iostream>
+#include <numeric>
+#include <optional>
 #include <random>
 #include <span>
 #include <sstream>
+#include <thread>
 
 #include "absl/log/check.h"
 #include "absl/random/random.h"
 #include "benchmark/benchmark.h"
+#include "compressed_keys.h"
+#include "concurrent_index.h"
 #include "lower_bound.h"
 #include "lower_bound_test.h"
 
@@ -69,6 +76,24 @@ enum class AccessPattern {
   kRandom,
 };
 
+// SearchMode names the API used to look up the keys.
+//
+// kSingle: one LowerBound call per key, each starting at the root.
+//
+// kBatch: one LowerBoundBatch call per batch of keys, which uses finger
+// search over sorted keys and sorts unsorted ones first.  A batch holds at
+// most one copy of the tree's keys, so AccessAscending batches are sorted.
+//
+// kCompressed: one CompressedKeys::LowerBound call per key, searching the
+// tree's keys in compressed blocks instead of its nodes.  The memory
+// layout does not apply.
+//
+enum class SearchMode {
+  kSingle,
+  kBatch,
+  kCompressed,
+};
+
 std::ostream& operator<<(std::ostream& os, MemoryLayout layout) {
   switch (layout) {
     case MemoryLayout::kAscending:
@@ -89,6 +114,18 @@ std::ostream& operator<<(std::ostream& os, AccessPattern pattern) {
   return os << "AccessPattern(" << static_cast<int>(pattern) << ')';
 }
 
+std::ostream& operator<<(std::ostream& os, SearchMode mode) {
+  switch (mode) {
+    case SearchMode::kSingle:
+      return os << "LowerBound";
+    case SearchMode::kBatch:
+      return os << "LowerBoundBatch";
+    case SearchMode::kCompressed:
+      return os << "LowerBoundCompressed";
+  }
+  return os << "SearchMode(" << static_cast<int>(mode) << ')';
+}
+
 constexpr bool kDebugLog = false;
 
 struct Fixture {
@@ -161,8 +198,8 @@ struct Fixture {
 
 int NodesForHeight(int height) { return (1U << height) - 1; }
 
-void BM_LowerBound(benchmark::State& state, MemoryLayout layout,
-                   AccessPattern access_pattern) {
+void BM_LowerBound(benchmark::State& state, SearchMode mode,
+                   MemoryLayout layout, AccessPattern access_pattern) {
   TreeProperties expected;
   expected.height = state.range(0);
   expected.size = NodesForHeight(expected.height);
@@ -177,6 +214,10 @@ void BM_LowerBound(benchmark::State& state, MemoryLayout layout,
   }
 
   Node* const root = fixture.root;
+  std::optional<CompressedKeys> compressed;
+  if (mode == SearchMode::kCompressed) {
+    compressed.emplace(KeysInOrder(root));
+  }
   if (false) {
     while (state.KeepRunningBatch(fixture.keys.size())) {
       for (int key : fixture.keys) {
@@ -184,10 +225,15 @@ void BM_LowerBound(benchmark::State& state, MemoryLayout layout,
       }
     }
   } else {
+    // Small trees repeat their keys to fill the fixture.  In batch mode,
+    // cap each batch at one copy of the keys so AccessAscending batches
+    // stay sorted and take the finger search path.
     const std::size_t kMaxBatchSize = 100000;
-    const std::size_t kBatchSize =
-        std::min<std::size_t>(fixture.keys.size(), kMaxBatchSize);
+    const std::size_t kBatchSize = std::min<std::size_t>(
+        mode == SearchMode::kBatch ? expected.size : fixture.keys.size(),
+        kMaxBatchSize);
 
+    std::vector<Node*> results(kBatchSize);
     const auto keys_end = fixture.keys.end();
     auto it = fixture.keys.end();
     while (state.KeepRunningBatch(kBatchSize)) {
@@ -195,9 +241,25 @@ void BM_LowerBound(benchmark::State& state, MemoryLayout layout,
         it = fixture.keys.begin();
       }
       auto batch_end = it + std::min<std::size_t>(kBatchSize, keys_end - it);
-      while (it != batch_end) {
-        benchmark::DoNotOptimize(LowerBound(root, *it));
-        it++;
+      switch (mode) {
+        case SearchMode::kSingle:
+          while (it != batch_end) {
+            benchmark::DoNotOptimize(LowerBound(root, *it));
+            it++;
+          }
+          break;
+        case SearchMode::kBatch:
+          LowerBoundBatch(root, std::span<const int>(it, batch_end), results);
+          benchmark::DoNotOptimize(results.data());
+          benchmark::ClobberMemory();
+          it = batch_end;
+          break;
+        case SearchMode::kCompressed:
+          while (it != batch_end) {
+            benchmark::DoNotOptimize(compressed->LowerBound(*it));
+            it++;
+          }
+          break;
       }
     }
   }
@@ -212,9 +274,146 @@ void BM_LowerBound(benchmark::State& state, MemoryLayout layout,
                            benchmark::Counter::kIsIterationInvariantRate |
                                benchmark::Counter::kInvert);
   }
+  // The compressed search never touches the nodes, so count the
+  // compressed keys in their place.
+  const std::size_t working_set_bytes =
+      compressed.has_value() ? compressed->MemoryBytes() +
+                                   fixture.keys.size() * sizeof(int)
+                             : fixture.WorkingSetBytes();
   state.counters["mem"] = benchmark::Counter(
-      static_cast<double>(fixture.WorkingSetBytes()),
-      benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+      static_cast<double>(working_set_bytes), benchmark::Counter::kDefaults,
+      benchmark::Counter::kIs1024);
+}
+
+// BM_ConcurrentIndex runs state.range(0) reader threads doing random
+// lookups in a ConcurrentIndex of height state.range(1), while one writer
+// thread slides the key window and republishes once per millisecond.
+//
+// items_per_second is the total reader throughput.  A sample of lookups
+// is timed individually to report p99_ns, and staleness_ms is the mean
+// age of the snapshot those lookups saw.
+void BM_ConcurrentIndex(benchmark::State& state) {
+  using Clock = std::chrono::steady_clock;
+  constexpr int kLookupsPerReader = 1 << 16;
+  constexpr int kSampleEvery = 16;
+  constexpr int kUpdatesPerPublish = 64;
+  constexpr auto kPublishInterval = std::chrono::milliseconds(1);
+
+  const int readers = state.range(0);
+  const int height = state.range(1);
+  const int size = NodesForHeight(height);
+
+  std::vector<int> keys(size);
+  std::iota(keys.begin(), keys.end(), 1);
+  ConcurrentIndex index(keys, readers);
+
+  // Readers look up offsets into the current window of keys in a random
+  // order.  Shuffle before truncating so large windows are sampled across
+  // their whole range rather than just their lowest keys.
+  absl::BitGen bitgen;
+  std::vector<std::vector<int>> offsets(readers);
+  for (std::vector<int>& reader_offsets : offsets) {
+    while (reader_offsets.size() < kLookupsPerReader) {
+      reader_offsets.insert(reader_offsets.end(), keys.begin(), keys.end());
+    }
+    std::shuffle(reader_offsets.begin(), reader_offsets.end(), bitgen);
+    reader_offsets.resize(kLookupsPerReader);
+  }
+
+  std::vector<std::vector<double>> latency_ns(readers);
+  std::vector<std::vector<double>> staleness_ns(readers);
+  int oldest_key = 1;
+  int next_key = size + 1;
+  std::int64_t publishes = 0;
+
+  for (auto _ : state) {
+    std::atomic<int> running = readers;
+    std::thread writer([&] {
+      while (running.load() > 0) {
+        // Never slide further than the window per publish.  Erases apply
+        // before inserts, so erasing keys inserted in the same publish
+        // would do nothing and the window would grow.
+        for (int i = 0; i < std::min(kUpdatesPerPublish, size); ++i) {
+          index.Erase(oldest_key++);
+          index.Insert(next_key++);
+        }
+        index.Publish();
+        ++publishes;
+        std::this_thread::sleep_for(kPublishInterval);
+      }
+    });
+
+    const Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int reader = 0; reader < readers; ++reader) {
+      threads.emplace_back([&, reader] {
+        const std::vector<int>& reader_offsets = offsets[reader];
+        for (int i = 0; i < kLookupsPerReader; ++i) {
+          const bool sampled = i % kSampleEvery == 0;
+          const Clock::time_point before =
+              sampled ? Clock::now() : Clock::time_point();
+          ConcurrentIndex::ReadGuard guard(index, reader);
+          const Snapshot& snapshot = guard.snapshot();
+          const int key = snapshot.nodes.front().key - 1 + reader_offsets[i];
+          benchmark::DoNotOptimize(guard.LowerBound(key));
+          if (sampled) {
+            const Clock::time_point after = Clock::now();
+            latency_ns[reader].push_back(
+                std::chrono::duration<double, std::nano>(after - before)
+                    .count());
+            staleness_ns[reader].push_back(
+                std::chrono::duration<double, std::nano>(after -
+                                                         snapshot.as_of)
+                    .count());
+          }
+        }
+        running.fetch_sub(1);
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    const Clock::time_point end = Clock::now();
+    writer.join();
+    state.SetIterationTime(std::chrono::duration<double>(end - start).count());
+  }
+  {
+    // The writer must slide the window, not grow it, or the height
+    // counter and the readers' offsets would no longer describe the tree.
+    ConcurrentIndex::ReadGuard guard(index, 0);
+    const std::vector<Node>& nodes = guard.snapshot().nodes;
+    if (nodes.size() != static_cast<std::size_t>(size) ||
+        nodes.back().key - nodes.front().key != size - 1) {
+      std::ostringstream os;
+      os << "key window drifted; expected " << size << " consecutive keys, "
+         << "got " << nodes.size() << " keys from " << nodes.front().key
+         << " to " << nodes.back().key;
+      state.SkipWithError(os.str().c_str());
+      return;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * readers * kLookupsPerReader);
+
+  std::vector<double> latencies;
+  std::vector<double> stalenesses;
+  for (int reader = 0; reader < readers; ++reader) {
+    latencies.insert(latencies.end(), latency_ns[reader].begin(),
+                     latency_ns[reader].end());
+    stalenesses.insert(stalenesses.end(), staleness_ns[reader].begin(),
+                       staleness_ns[reader].end());
+  }
+  auto p99 = latencies.begin() + latencies.size() * 99 / 100;
+  std::nth_element(latencies.begin(), p99, latencies.end());
+
+  state.counters["height"] = benchmark::Counter(static_cast<double>(height));
+  state.counters["readers"] =
+      benchmark::Counter(static_cast<double>(readers));
+  state.counters["p99_ns"] = benchmark::Counter(*p99);
+  state.counters["staleness_ms"] = benchmark::Counter(
+      std::accumulate(stalenesses.begin(), stalenesses.end(), 0.0) /
+      stalenesses.size() / 1e6);
+  state.counters["publishes"] = benchmark::Counter(
+      static_cast<double>(publishes), benchmark::Counter::kIsRate);
 }
 
 int MaxCacheSize() {
@@ -238,25 +437,48 @@ void RegisterAll() {
   int max_cache_size = MaxCacheSize();
   int target_working_set_size = max_cache_size / 2;
 
-  for (MemoryLayout layout :
-       {MemoryLayout::kAscending, MemoryLayout::kRandom}) {
-    for (AccessPattern access :
-         {AccessPattern::kAscending, AccessPattern::kRandom}) {
-      std::ostringstream os;
-      os << "LowerBound/" << layout << '/' << access;
-      auto* benchmark = benchmark::RegisterBenchmark(
-          os.str().c_str(), [layout, access](benchmark::State& state) {
-            BM_LowerBound(state, layout, access);
-          });
-      for (int height = 1; height <= 30; ++height) {
-        benchmark->Arg(height);
-        if (Fixture::EstimateWorkingSetBytes(NodesForHeight(height)) >=
-            target_working_set_size) {
-          break;
+  for (SearchMode mode :
+       {SearchMode::kSingle, SearchMode::kBatch, SearchMode::kCompressed}) {
+    for (MemoryLayout layout :
+         {MemoryLayout::kAscending, MemoryLayout::kRandom}) {
+      if (mode == SearchMode::kCompressed &&
+          layout != MemoryLayout::kAscending) {
+        continue;
+      }
+      for (AccessPattern access :
+           {AccessPattern::kAscending, AccessPattern::kRandom}) {
+        std::ostringstream os;
+        os << mode << '/' << layout << '/' << access;
+        auto* benchmark = benchmark::RegisterBenchmark(
+            os.str().c_str(), [mode, layout, access](benchmark::State& state) {
+              BM_LowerBound(state, mode, layout, access);
+            });
+        for (int height = 1; height <= 30; ++height) {
+          benchmark->Arg(height);
+          if (Fixture::EstimateWorkingSetBytes(NodesForHeight(height)) >=
+              target_working_set_size) {
+            break;
+          }
         }
       }
     }
   }
+
+  std::ostringstream os;
+  os << "ConcurrentIndex/" << MemoryLayout::kAscending << '/'
+     << AccessPattern::kRandom;
+  auto* benchmark =
+      benchmark::RegisterBenchmark(os.str().c_str(), BM_ConcurrentIndex);
+  benchmark->UseManualTime();
+  for (int readers : {1, 2, 4}) {
+    for (int height = 1; height <= 30; ++height) {
+      benchmark->Args({readers, height});
+      if (Fixture::EstimateWorkingSetBytes(NodesForHeight(height)) >=
+          target_working_set_size) {
+        break;
+      }
+    }
+  }
 }
 
 }  // namespace
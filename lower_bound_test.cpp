@@ -136,4 +136,97 @@ TEST(LowerBound, LayoutAtRandom) {
   EXPECT_GE(distinct_layouts.size(), kGenerateCount - kMaxDuplicates);
 }
 
+TEST(LowerBound, LowerBoundSorted) {
+  using lower_bound::LowerBound;
+  using lower_bound::LowerBoundSorted;
+  using lower_bound::Node;
+
+  Node sentinel;
+  std::vector<Node*> results(3, &sentinel);
+  LowerBoundSorted(nullptr, std::vector<int>{1, 2, 3}, results);
+  EXPECT_THAT(results, testing::Each(nullptr));
+
+  // Probe every key, the gaps around them, and repeats, against both
+  // layouts.  Walking the keys in order forces the finger to climb from
+  // every leaf to every possible ancestor.
+  absl::BitGen bitgen;
+  for (int size : {1, 3, 7, 15, 127}) {
+    std::vector<Node> ascending(size);
+    std::vector<Node> random(size);
+    for (Node* root : {LayoutAscending(ascending),
+                       LayoutAtRandom(random, bitgen)}) {
+      std::vector<int> keys;
+      for (int key = -1; key <= size + 2; ++key) {
+        keys.push_back(key);
+        keys.push_back(key);
+      }
+      results.assign(keys.size(), nullptr);
+      LowerBoundSorted(root, keys, results);
+      for (std::size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ(results[i], LowerBound(root, keys[i]))
+            << "size " << size << " key " << keys[i];
+      }
+    }
+  }
+}
+
+TEST(LowerBound, LowerBoundSortedDuplicateKeys) {
+  using lower_bound::LowerBoundSorted;
+  using lower_bound::Node;
+  using testing::ElementsAre;
+
+  // The shape of the complete tree of 7 nodes, with duplicate keys:
+  //
+  //             4
+  //           /   \
+  //          2     4
+  //         / \   / \
+  //        2   2 4   6
+  //
+  // LowerBound must return the leftmost of each run of duplicates.
+  std::vector<Node> nodes(7);
+  Node* root = LayoutAscending(nodes);
+  const int kKeys[] = {2, 2, 2, 4, 4, 4, 6};
+  for (int i = 0; i < 7; ++i) {
+    nodes[i].key = kKeys[i];
+  }
+
+  std::vector<int> keys = {1, 2, 3, 4, 5, 6, 7};
+  std::vector<Node*> results(keys.size());
+  LowerBoundSorted(root, keys, results);
+  EXPECT_THAT(results, ElementsAre(&nodes[0], &nodes[0], &nodes[3], &nodes[3],
+                                   &nodes[6], &nodes[6], nullptr));
+}
+
+TEST(LowerBound, LowerBoundBatch) {
+  using lower_bound::LowerBound;
+  using lower_bound::LowerBoundBatch;
+  using lower_bound::Node;
+
+  absl::BitGen bitgen;
+  std::vector<Node> nodes(1023);
+  Node* root = LayoutAtRandom(nodes, bitgen);
+
+  // Cover the sorted, the small unsorted and the large unsorted paths.
+  for (int count : {0, 5, 10, 1000}) {
+    std::vector<int> keys;
+    for (int i = 0; i < count; ++i) {
+      keys.push_back(absl::Uniform(bitgen, -5, 1030));
+    }
+    for (bool sorted : {true, false}) {
+      if (sorted) {
+        std::sort(keys.begin(), keys.end());
+      } else {
+        std::shuffle(keys.begin(), keys.end(), bitgen);
+      }
+      std::vector<Node*> results(keys.size());
+      LowerBoundBatch(root, keys, results);
+      for (std::size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ(results[i], LowerBound(root, keys[i]))
+            << "count " << count << " key " << keys[i];
+      }
+    }
+  }
+}
+
 }  // namespace